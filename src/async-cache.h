@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "./task.h"
+
+struct AsyncCacheStats {
+    long hits;
+    long misses;
+    long coalesced;
+    long evictions;
+    long expirations;
+    long uncached;
+    long abandoned;
+    int size;
+};
+
+// Single-flight cache of Task results. Concurrent misses on a key share one
+// run of the loader and every waiter gets the same shared_ptr, so the value
+// is never copied. Loaded values live for ttlMs and each stripe keeps at most
+// capacity / stripes of them, evicting the least recently used.
+//
+// Every result is cached unless a `cacheable` predicate is given; results
+// it turns down (e.g. rejections, as in Task::Or) still reach the waiters
+// and are counted as uncached. A loader that drops its handler without
+// resolving it resolves its waiters with an empty Value instead, so they
+// can tell with Task::Or, and the next Get loads again. The cache must
+// outlive every Task it returns.
+template <template <typename> class Func, typename K, typename V, typename Hash = std::hash<K>>
+class AsyncCache {
+public:
+    using Value = std::shared_ptr<const V>;
+    using Handler = typename Task<Func, Value>::Handler;
+    // Milliseconds on any monotonic clock, e.g. VirtualTimeRunner::Now.
+    using Now = Func<long long()>;
+    using Cacheable = Func<bool(const V &)>;
+
+private:
+    struct Entry {
+        Value value_;
+        long long expires_ = 0;
+        std::vector<Handler> waiters_;
+        typename std::list<K>::iterator lru_;
+        bool loading_ = true;
+    };
+
+    struct alignas(64) Stripe {
+        std::mutex mutex_;
+        std::unordered_map<K, Entry, Hash> entries_;
+        std::list<K> lru_;   // loaded keys, most recently used first
+        long hits_ = 0;
+        long misses_ = 0;
+        long coalesced_ = 0;
+        long evictions_ = 0;
+        long expirations_ = 0;
+        long uncached_ = 0;
+        long abandoned_ = 0;
+    };
+
+    // Owned by the loader's handler; settles the load if the last copy of
+    // the handler goes away unresolved.
+    class Load {
+    private:
+        AsyncCache *cache_;
+        K key_;
+        std::atomic<bool> done_{false};
+    public:
+        Load(AsyncCache *cache, const K &key): cache_(cache), key_(key) { }
+
+        ~Load() {
+            if (!done_.load(std::memory_order_acquire)) {
+                cache_->Abandon(key_);
+            }
+        }
+
+        void Resolve(V &&v) {
+            if (!done_.exchange(true, std::memory_order_acq_rel)) {
+                cache_->Complete(key_, std::move(v));
+            }
+        }
+    };
+
+    const std::size_t stripeCapacity_;
+    const long long ttlMs_;
+    Now now_;
+    Cacheable cacheable_;
+    Hash hash_;
+    std::vector<Stripe> stripes_;
+
+    Stripe &StripeFor(const K &key) {
+        return stripes_[hash_(key) % stripes_.size()];
+    }
+
+    void Complete(const K &key, V &&v) {
+        Value value = std::make_shared<const V>(std::move(v));
+        std::vector<Handler> waiters;
+        {
+            Stripe &stripe = StripeFor(key);
+            std::lock_guard<std::mutex> lock(stripe.mutex_);
+            auto it = stripe.entries_.find(key);
+            // A loader that resolves more than once only counts the first time.
+            if (it == stripe.entries_.end() || !it->second.loading_) {
+                return;
+            }
+            waiters = std::move(it->second.waiters_);
+            if (!cacheable_ || cacheable_(*value)) {
+                Entry &entry = it->second;
+                entry.value_ = value;
+                entry.expires_ = now_() + ttlMs_;
+                entry.loading_ = false;
+                stripe.lru_.push_front(key);
+                entry.lru_ = stripe.lru_.begin();
+                while (stripe.lru_.size() > stripeCapacity_) {
+                    stripe.entries_.erase(stripe.lru_.back());
+                    stripe.lru_.pop_back();
+                    stripe.evictions_++;
+                }
+            } else {
+                stripe.entries_.erase(it);
+                stripe.uncached_++;
+            }
+        }
+        for (Handler &waiter : waiters) {
+            Value shared = value;
+            waiter(std::move(shared));
+        }
+    }
+
+    void Abandon(const K &key) {
+        std::vector<Handler> waiters;
+        {
+            Stripe &stripe = StripeFor(key);
+            std::lock_guard<std::mutex> lock(stripe.mutex_);
+            auto it = stripe.entries_.find(key);
+            if (it == stripe.entries_.end() || !it->second.loading_) {
+                return;
+            }
+            waiters = std::move(it->second.waiters_);
+            stripe.entries_.erase(it);
+            stripe.abandoned_++;
+        }
+        for (Handler &waiter : waiters) {
+            waiter(Value());
+        }
+    }
+
+public:
+    // Constructors
+    AsyncCache(std::size_t capacity, long long ttlMs, std::size_t stripes = 16, Now now = nullptr, Cacheable cacheable = nullptr)
+        : stripeCapacity_(std::max<std::size_t>(1, capacity / std::max<std::size_t>(1, stripes)))
+        , ttlMs_(ttlMs)
+        , now_(now ? std::move(now) : Now([]() {
+            return (long long)std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }))
+        , cacheable_(std::move(cacheable))
+        , stripes_(std::max<std::size_t>(1, stripes)) { }
+
+    AsyncCache(const AsyncCache &) = delete;
+    AsyncCache &operator = (const AsyncCache &) = delete;
+
+    // The lookup happens each time the returned Task runs; the loader only
+    // runs on a miss that no other caller is already loading.
+    Task<Func, Value> Get(const K &key, const Task<Func, V> &loader) {
+        return Task<Func, Value>([this, key, loader](const Handler &handler) {
+            Value hit;
+            {
+                Stripe &stripe = StripeFor(key);
+                std::lock_guard<std::mutex> lock(stripe.mutex_);
+                auto it = stripe.entries_.find(key);
+                if (it != stripe.entries_.end() && it->second.loading_) {
+                    it->second.waiters_.push_back(handler);
+                    stripe.coalesced_++;
+                    return;
+                }
+                if (it != stripe.entries_.end() && it->second.expires_ > now_()) {
+                    stripe.lru_.splice(stripe.lru_.begin(), stripe.lru_, it->second.lru_);
+                    stripe.hits_++;
+                    hit = it->second.value_;
+                } else {
+                    if (it != stripe.entries_.end()) {
+                        stripe.lru_.erase(it->second.lru_);
+                        stripe.entries_.erase(it);
+                        stripe.expirations_++;
+                    }
+                    Entry &entry = stripe.entries_[key];
+                    entry.waiters_.push_back(handler);
+                    stripe.misses_++;
+                }
+            }
+            if (hit) {
+                handler(std::move(hit));
+                return;
+            }
+            auto load = std::make_shared<Load>(this, key);
+            loader.Run([load](V &&v) {
+                load->Resolve(std::move(v));
+            });
+        });
+    }
+
+    AsyncCacheStats Stats() {
+        AsyncCacheStats stats{};
+        for (Stripe &stripe : stripes_) {
+            std::lock_guard<std::mutex> lock(stripe.mutex_);
+            stats.hits += stripe.hits_;
+            stats.misses += stripe.misses_;
+            stats.coalesced += stripe.coalesced_;
+            stats.evictions += stripe.evictions_;
+            stats.expirations += stripe.expirations_;
+            stats.uncached += stripe.uncached_;
+            stats.abandoned += stripe.abandoned_;
+            stats.size += (int)stripe.lru_.size();
+        }
+        return stats;
+    }
+};
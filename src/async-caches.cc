@@ -0,0 +1,81 @@
+#include <string>
+
+#include "./async-caches.h"
+#include "./async-cache.h"
+#include "./task.h"
+#include "./virtual-time-runner.h"
+#include "./thread-log.h"
+
+template <typename T>
+using Tk = Task<std::function, T>;
+
+template <typename T>
+using Hdl = typename Tk<T>::Handler;
+
+using Cache = AsyncCache<std::function, int, std::string>;
+
+std::ostream &operator << (std::ostream &ostm, const AsyncCacheStats &stats) {
+    return ostm << "AsyncCacheStats(hits=" << stats.hits
+                << ", misses=" << stats.misses
+                << ", coalesced=" << stats.coalesced
+                << ", evictions=" << stats.evictions
+                << ", expirations=" << stats.expirations
+                << ", uncached=" << stats.uncached
+                << ", abandoned=" << stats.abandoned
+                << ", size=" << stats.size
+                << ")";
+}
+
+void AsyncCachesDemo::run() {
+    VirtualTimeRunner clock;
+    auto runner = [&clock](int ms, std::function<void()> &&callback) {
+        clock.delay(ms, std::move(callback));
+    };
+
+    // Backend takes 100ms per load
+    int loads = 0;
+    auto backend = [&loads, runner](int key) {
+        return Tk<std::string>([&loads, key](const Hdl<std::string> &handler) {
+            loads++;
+            handler("value-" + std::to_string(key));
+        }).ThenDelayFor(runner, 100);
+    };
+
+    // 4 entries in 2 stripes, 1s TTL, on the virtual clock
+    Cache cache(4, 1000, 2, [&clock]() { return clock.Now(); });
+
+    // Ten concurrent requests for one key share a single load
+    const std::string *first = nullptr;
+    bool shared = true;
+    for (int i = 0; i < 10; ++i) {
+        cache.Get(1, backend(1)).Run([&first, &shared](Cache::Value &&value) {
+            first = first ? first : value.get();
+            shared = shared && first == value.get();
+        });
+    }
+    clock.RunUntilIdle();
+    threadLog("Loads", loads, "same object for every waiter", shared, cache.Stats());
+
+    // Served from the cache until the TTL passes
+    cache.Get(1, backend(1)).Run([](Cache::Value &&value) { threadLog("Hit", *value); });
+    clock.AdvanceBy(1000);
+    cache.Get(1, backend(1)).Run([](Cache::Value &&value) { threadLog("Reloaded", *value); });
+    clock.RunUntilIdle();
+    threadLog("Loads", loads, cache.Stats());
+
+    // Filling past capacity evicts the least recently used
+    for (int key = 2; key <= 8; ++key) {
+        cache.Get(key, backend(key)).Run([](Cache::Value &&) { });
+    }
+    clock.RunUntilIdle();
+    threadLog("Loads", loads, cache.Stats());
+
+    // Empty results are treated as failures and loaded again next time
+    Cache checked(4, 1000, 2, [&clock]() { return clock.Now(); }, [](const std::string &value) { return !value.empty(); });
+    auto failing = Tk<std::string>::Resolve("");
+    for (int i = 0; i < 2; ++i) {
+        checked.Get(1, failing).Run([](Cache::Value &&) { });
+        clock.RunUntilIdle();
+    }
+    threadLog("Checked", checked.Stats());
+}
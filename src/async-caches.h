@@ -0,0 +1,7 @@
+#pragma once
+
+class AsyncCachesDemo {
+public:
+    static constexpr const char* name = "AsyncCaches";
+    static void run();
+};
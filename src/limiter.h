@@ -0,0 +1,349 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "./task.h"
+
+struct AdmissionStats {
+    int queueDepth;
+    int maxQueueDepth;
+    long admitted;
+    long queued;
+    long rejected;
+    long long totalWaitUs;
+    long long maxWaitUs;
+};
+
+// FIFO of work waiting to be admitted. The owner serializes Push / Pop with
+// its own mutex; the counters are atomics so Stats() can be read anywhere.
+template <template <typename> class Func>
+class AdmissionQueue {
+public:
+    using Clock = std::chrono::steady_clock;
+
+private:
+    struct Waiter {
+        Clock::time_point enqueued_;
+        Func<void()> start_;
+    };
+
+    std::deque<Waiter> waiters_;
+    const int maxQueue_;
+    std::atomic<int> depth_{0};
+    std::atomic<int> maxDepth_{0};
+    std::atomic<long> admitted_{0};
+    std::atomic<long> queued_{0};
+    std::atomic<long> rejected_{0};
+    std::atomic<long long> totalWaitUs_{0};
+    std::atomic<long long> maxWaitUs_{0};
+
+public:
+    // A negative maxQueue means the queue is unbounded and nothing is shed.
+    explicit AdmissionQueue(int maxQueue): maxQueue_(maxQueue) { }
+
+    bool Empty() const {
+        return waiters_.empty();
+    }
+
+    // Returns false, and counts a rejection, if the queue is full.
+    bool Push(Func<void()> &&start) {
+        if (maxQueue_ >= 0 && (int)waiters_.size() >= maxQueue_) {
+            rejected_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        waiters_.push_back({ Clock::now(), std::move(start) });
+        int depth = depth_.fetch_add(1, std::memory_order_relaxed) + 1;
+        int maxDepth = maxDepth_.load(std::memory_order_relaxed);
+        while (depth > maxDepth && !maxDepth_.compare_exchange_weak(maxDepth, depth, std::memory_order_relaxed)) { }
+        return true;
+    }
+
+    Func<void()> Pop() {
+        Waiter waiter = std::move(waiters_.front());
+        waiters_.pop_front();
+        depth_.fetch_sub(1, std::memory_order_relaxed);
+
+        long long waitUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - waiter.enqueued_).count();
+        totalWaitUs_.fetch_add(waitUs, std::memory_order_relaxed);
+        long long maxWaitUs = maxWaitUs_.load(std::memory_order_relaxed);
+        while (waitUs > maxWaitUs && !maxWaitUs_.compare_exchange_weak(maxWaitUs, waitUs, std::memory_order_relaxed)) { }
+
+        queued_.fetch_add(1, std::memory_order_relaxed);
+        admitted_.fetch_add(1, std::memory_order_relaxed);
+        return std::move(waiter.start_);
+    }
+
+    void CountAdmitted() {
+        admitted_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    AdmissionStats Stats() const {
+        return {
+            depth_.load(std::memory_order_relaxed),
+            maxDepth_.load(std::memory_order_relaxed),
+            admitted_.load(std::memory_order_relaxed),
+            queued_.load(std::memory_order_relaxed),
+            rejected_.load(std::memory_order_relaxed),
+            totalWaitUs_.load(std::memory_order_relaxed),
+            maxWaitUs_.load(std::memory_order_relaxed),
+        };
+    }
+};
+
+// Caps the number of wrapped tasks in flight. Slots are taken with a CAS on
+// an atomic counter; overflow waits in FIFO order and a finishing task hands
+// its slot straight to the head of the queue.
+//
+// Shed work resolves with T(), which Task::Or treats as a rejection. The
+// limiter must outlive every task it wraps.
+template <template <typename> class Func>
+class Limiter {
+private:
+    const int maxInFlight_;
+    std::atomic<int> inFlight_{0};
+    std::mutex mutex_;
+    AdmissionQueue<Func> queue_;
+
+    bool TryAcquire() {
+        int n = inFlight_.load(std::memory_order_relaxed);
+        while (n < maxInFlight_) {
+            if (inFlight_.compare_exchange_weak(n, n + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Runs start on this thread, unless a hand-off is already running here,
+    // in which case the outer loop picks it up. Tasks that complete on the
+    // thread that started them would otherwise nest one frame per hand-off.
+    static void Trampoline(Func<void()> &&start) {
+        thread_local std::deque<Func<void()>> pending;
+        thread_local bool draining = false;
+
+        // Clears the flag even if something below throws, so later hand-offs
+        // on this thread still run.
+        struct Draining {
+            bool &draining_;
+            explicit Draining(bool &draining): draining_(draining) { draining_ = true; }
+            ~Draining() { draining_ = false; }
+        };
+
+        pending.push_back(std::move(start));
+        if (draining) {
+            return;
+        }
+        Draining guard(draining);
+        // A throwing start must not strand the hand-offs queued behind it:
+        // keep draining and rethrow the first error at the end.
+        std::exception_ptr error;
+        while (!pending.empty()) {
+            Func<void()> next = std::move(pending.front());
+            pending.pop_front();
+            try {
+                next();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    void Release() {
+        Func<void()> next;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (queue_.Empty()) {
+                inFlight_.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+            next = queue_.Pop();
+        }
+        Trampoline(std::move(next));
+    }
+
+    bool Admit(Func<void()> &&start) {
+        if (!TryAcquire()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // Re-check under the lock: a Release may have freed a slot
+            // between the failed CAS and here.
+            if (!TryAcquire()) {
+                return queue_.Push(std::move(start));
+            }
+        }
+        queue_.CountAdmitted();
+        start();
+        return true;
+    }
+
+public:
+    // Constructors
+    Limiter(int maxInFlight, int maxQueue = -1): maxInFlight_(maxInFlight), queue_(maxQueue) { }
+
+    Limiter(const Limiter &) = delete;
+    Limiter &operator = (const Limiter &) = delete;
+
+    template <typename T>
+    Task<Func, T> Wrap(const Task<Func, T> &task) {
+        using Handler = typename Task<Func, T>::Handler;
+        return Task<Func, T>([this, task](const Handler &handler) {
+            bool admitted = Admit([this, task, handler]() {
+                // Give the slot back exactly once: after the handler, or if
+                // the handler or the task itself throws.
+                auto released = std::make_shared<std::atomic<bool>>(false);
+                auto release = [this, released]() {
+                    if (!released->exchange(true, std::memory_order_acq_rel)) {
+                        Release();
+                    }
+                };
+                try {
+                    task.Run([handler, release](T &&t) {
+                        try {
+                            handler(std::move(t));
+                        } catch (...) {
+                            release();
+                            throw;
+                        }
+                        release();
+                    });
+                } catch (...) {
+                    release();
+                    throw;
+                }
+            });
+            if (!admitted) {
+                handler(T());
+            }
+        });
+    }
+
+    int InFlight() const {
+        return inFlight_.load(std::memory_order_relaxed);
+    }
+
+    AdmissionStats Stats() const {
+        return queue_.Stats();
+    }
+};
+
+// Token bucket. Each wrapped task takes one token when it starts; tokens come
+// back through the DelayedRunner, refillTokens every refillMs, and the refill
+// timer only runs while the bucket is below capacity.
+//
+// Shed work resolves with T(), like Limiter. The rate limiter must outlive
+// every task it wraps and every refill it schedules on the runner.
+template <template <typename> class Func>
+class RateLimiter {
+public:
+    using DelayedRunner = Func<void(int, Func<void()> &&)>;
+
+private:
+    DelayedRunner runner_;
+    const int capacity_;
+    const int refillMs_;
+    const int refillTokens_;
+    std::atomic<int> tokens_;
+    std::atomic<bool> refillPending_{false};
+    std::mutex mutex_;
+    AdmissionQueue<Func> queue_;
+
+    bool TryAcquire() {
+        int n = tokens_.load(std::memory_order_relaxed);
+        while (n > 0) {
+            if (tokens_.compare_exchange_weak(n, n - 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ScheduleRefill() {
+        if (!refillPending_.exchange(true, std::memory_order_acq_rel)) {
+            runner_(refillMs_, [this]() { Refill(); });
+        }
+    }
+
+    void Refill() {
+        std::vector<Func<void()>> ready;
+        bool more = false;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            int n = tokens_.load(std::memory_order_relaxed);
+            while (!tokens_.compare_exchange_weak(n, std::min(capacity_, n + refillTokens_), std::memory_order_release, std::memory_order_relaxed)) { }
+
+            while (!queue_.Empty() && TryAcquire()) {
+                ready.push_back(queue_.Pop());
+            }
+            refillPending_.store(false, std::memory_order_release);
+            more = tokens_.load(std::memory_order_relaxed) < capacity_;
+        }
+        if (more) {
+            ScheduleRefill();
+        }
+        for (auto &start : ready) {
+            start();
+        }
+    }
+
+    bool Admit(Func<void()> &&start) {
+        if (!TryAcquire()) {
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (!TryAcquire()) {
+                bool queued = queue_.Push(std::move(start));
+                lock.unlock();
+                ScheduleRefill();
+                return queued;
+            }
+        }
+        queue_.CountAdmitted();
+        ScheduleRefill();
+        start();
+        return true;
+    }
+
+public:
+    // Constructors
+    RateLimiter(const DelayedRunner &runner, int capacity, int refillMs, int refillTokens = 1, int maxQueue = -1)
+        : runner_(runner)
+        , capacity_(capacity)
+        , refillMs_(refillMs)
+        , refillTokens_(refillTokens)
+        , tokens_(capacity)
+        , queue_(maxQueue) { }
+
+    RateLimiter(const RateLimiter &) = delete;
+    RateLimiter &operator = (const RateLimiter &) = delete;
+
+    template <typename T>
+    Task<Func, T> Wrap(const Task<Func, T> &task) {
+        using Handler = typename Task<Func, T>::Handler;
+        return Task<Func, T>([this, task](const Handler &handler) {
+            bool admitted = Admit([task, handler]() {
+                task.Run(handler);
+            });
+            if (!admitted) {
+                handler(T());
+            }
+        });
+    }
+
+    int Tokens() const {
+        return tokens_.load(std::memory_order_relaxed);
+    }
+
+    AdmissionStats Stats() const {
+        return queue_.Stats();
+    }
+};
@@ -0,0 +1,81 @@
+#include <optional>
+
+#include "./limiters.h"
+#include "./limiter.h"
+#include "./task.h"
+#include "./threaded-runner.h"
+#include "./thread-log.h"
+
+template <typename T>
+using Tk = Task<std::function, T>;
+
+template <typename T>
+using Hdl = typename Tk<T>::Handler;
+
+std::ostream &operator << (std::ostream &ostm, const AdmissionStats &stats) {
+    return ostm << "AdmissionStats(admitted=" << stats.admitted
+                << ", queued=" << stats.queued
+                << ", rejected=" << stats.rejected
+                << ", maxQueueDepth=" << stats.maxQueueDepth
+                << ", maxWaitUs=" << stats.maxWaitUs
+                << ")";
+}
+
+struct Outcome {
+    std::optional<int> value_;
+    Outcome(): value_(std::nullopt) { }
+    Outcome(int value): value_(value) { }
+
+    explicit operator bool() const {
+        return (bool)value_;
+    }
+};
+
+std::ostream &operator << (std::ostream &ostm, const Outcome &outcome) {
+    if (outcome.value_.has_value()) {
+        return ostm << "Outcome(" << outcome.value_.value() << ")";
+    }
+    return ostm << "Outcome(rejected)";
+}
+
+void LimitersDemo::run() {
+    ThreadedRunner threadedRunner;
+    auto runner = [&threadedRunner](int ms, std::function<void()> &&callback) {
+        threadedRunner.delay(ms, std::move(callback));
+    };
+
+    // At most 2 in flight, the rest wait in FIFO order
+    Limiter<std::function> limiter(2);
+    for (int i = 0; i < 5; ++i) {
+        auto task = Tk<Outcome>([i](const Hdl<Outcome> &handler) {
+            threadLog("Kickoff limited task", i);
+            handler(i);
+        }).ThenDelayFor(runner, 500);
+
+        limiter.Wrap(task).Run(threadLog<const Outcome &>);
+    }
+
+    // At most 1 in flight and 1 waiting, the rest are shed
+    Limiter<std::function> shedding(1, 1);
+    for (int i = 0; i < 4; ++i) {
+        auto task = Tk<Outcome>::Resolve(i).ThenDelayFor(runner, 500);
+        shedding.Wrap(task).Run(threadLog<const Outcome &>);
+    }
+
+    // Burst of 2, then 1 token every 300ms
+    RateLimiter<std::function> rateLimiter(runner, 2, 300);
+    for (int i = 0; i < 5; ++i) {
+        auto task = Tk<Outcome>([i](const Hdl<Outcome> &handler) {
+            threadLog("Kickoff rate limited task", i);
+            handler(i);
+        });
+
+        rateLimiter.Wrap(task).Run(threadLog<const Outcome &>);
+    }
+
+    threadedRunner.join();
+
+    threadLog("Limiter", limiter.Stats());
+    threadLog("Shedding limiter", shedding.Stats());
+    threadLog("Rate limiter", rateLimiter.Stats());
+}
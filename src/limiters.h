@@ -0,0 +1,7 @@
+#pragma once
+
+class LimitersDemo {
+public:
+    static constexpr const char* name = "Limiters";
+    static void run();
+};
@@ -6,6 +6,14 @@
 #include "./tasks.h"
 #include "./tasks2.h"
 #include "./tasks3.h"
+#include "./limiters.h"
+#include "./shards.h"
+#include "./parallels.h"
+#include "./virtual-time.h"
+#include "./sync-waits.h"
+#include "./task-graphs.h"
+#include "./priority-lanes.h"
+#include "./async-caches.h"
 
 int f(int &&x) {
     return 0;
@@ -16,5 +24,13 @@ int main() {
     // runDemo<CoroutineDemo>();
     // runDemo<TasksDemo>();
     runDemo<Tasks3Demo>();
+    // runDemo<LimitersDemo>();
+    // runDemo<ShardsDemo>();
+    // runDemo<ParallelsDemo>();
+    // runDemo<VirtualTimeDemo>();
+    // runDemo<SyncWaitsDemo>();
+    // runDemo<TaskGraphsDemo>();
+    // runDemo<PriorityLanesDemo>();
+    // runDemo<AsyncCachesDemo>();
     return 0;
 }
@@ -0,0 +1,159 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <ranges>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "./task.h"
+#include "./thread-pool.h"
+
+// Data-parallel helpers. The input is cut into chunks of `grain` elements
+// (0 picks roughly an L1 cache worth of T), every chunk runs on the pool,
+// and the Task resolves on whichever worker finishes the last chunk.
+//
+// Each helper also takes any contiguous container (std::vector, std::array,
+// a mutable std::span, ...) and views it as a span. The data is not copied:
+// it must stay alive until the Task resolves.
+
+namespace parallel_detail {
+
+constexpr std::size_t CacheBytes = 32 * 1024;
+
+template <typename T>
+std::size_t Grain(std::size_t grain) {
+    return grain > 0 ? grain : std::max<std::size_t>(1, CacheBytes / sizeof(T));
+}
+
+// Calls chunk(begin, end) for every chunk on the pool, then done() once.
+inline void ForChunks(ThreadPool &pool, std::size_t size, std::size_t grain,
+                      std::function<void(std::size_t, std::size_t)> chunk,
+                      std::function<void()> done) {
+    std::size_t chunks = (size + grain - 1) / grain;
+    if (chunks == 0) {
+        done();
+        return;
+    }
+    auto remaining = std::make_shared<std::atomic<std::size_t>>(chunks);
+    for (std::size_t begin = 0; begin < size; begin += grain) {
+        std::size_t end = std::min(size, begin + grain);
+        pool.submit([chunk, done, remaining, begin, end]() {
+            chunk(begin, end);
+            if (remaining->fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                done();
+            }
+        });
+    }
+}
+
+template <typename R>
+concept ContiguousInput = std::ranges::contiguous_range<R> && std::ranges::sized_range<R>;
+
+template <typename R>
+auto ConstSpan(const R &input) {
+    return std::span<const std::ranges::range_value_t<R>>(std::ranges::data(input), std::ranges::size(input));
+}
+
+}
+
+template <template <typename> class Func, typename T, typename F,
+          typename U = std::decay_t<std::invoke_result_t<F &, const T &>>>
+Task<Func, std::vector<U>> ParallelMap(ThreadPool &pool, std::span<const T> input, F f, std::size_t grain = 0) {
+    static_assert(!std::is_same_v<U, bool>, "std::vector<bool> elements cannot be written concurrently");
+    using Handler = typename Task<Func, std::vector<U>>::Handler;
+
+    return Task<Func, std::vector<U>>([&pool, input, f, grain](const Handler &handler) {
+        // Each chunk writes its own slice of the output, so no locking.
+        auto output = std::make_shared<std::vector<U>>(input.size());
+        parallel_detail::ForChunks(pool, input.size(), parallel_detail::Grain<T>(grain),
+            [input, f, output](std::size_t begin, std::size_t end) {
+                U *out = output->data();
+                for (std::size_t i = begin; i < end; ++i) {
+                    out[i] = f(input[i]);
+                }
+            },
+            [output, handler]() {
+                handler(std::move(*output));
+            });
+    });
+}
+
+template <template <typename> class Func, parallel_detail::ContiguousInput R, typename F>
+auto ParallelMap(ThreadPool &pool, const R &input, F f, std::size_t grain = 0) {
+    return ParallelMap<Func>(pool, parallel_detail::ConstSpan(input), f, grain);
+}
+
+// Folds each chunk from `identity` with reduce(U, const T &), then folds the
+// chunk results in input order with combine(U, U). The operations need to be
+// associative, not commutative.
+template <template <typename> class Func, typename T, typename U, typename Reduce, typename Combine>
+    requires std::is_invocable_r_v<U, Combine &, U, U>
+Task<Func, U> ParallelReduce(ThreadPool &pool, std::span<const T> input, U identity, Reduce reduce, Combine combine, std::size_t grain = 0) {
+    using Handler = typename Task<Func, U>::Handler;
+
+    return Task<Func, U>([&pool, input, identity, reduce, combine, grain](const Handler &handler) {
+        std::size_t chunkSize = parallel_detail::Grain<T>(grain);
+        std::size_t chunks = (input.size() + chunkSize - 1) / chunkSize;
+        auto partials = std::make_shared<std::vector<U>>(chunks, identity);
+        parallel_detail::ForChunks(pool, input.size(), chunkSize,
+            [input, reduce, partials, chunkSize](std::size_t begin, std::size_t end) {
+                U acc = (*partials)[begin / chunkSize];
+                for (std::size_t i = begin; i < end; ++i) {
+                    acc = reduce(std::move(acc), input[i]);
+                }
+                (*partials)[begin / chunkSize] = std::move(acc);
+            },
+            [identity, combine, partials, handler]() {
+                U result = identity;
+                for (U &partial : *partials) {
+                    result = combine(std::move(result), std::move(partial));
+                }
+                handler(std::move(result));
+            });
+    });
+}
+
+template <template <typename> class Func, typename T, typename Reduce>
+Task<Func, T> ParallelReduce(ThreadPool &pool, std::span<const T> input, T identity, Reduce reduce, std::size_t grain = 0) {
+    return ParallelReduce<Func>(pool, input, std::move(identity), reduce, reduce, grain);
+}
+
+template <template <typename> class Func, parallel_detail::ContiguousInput R, typename U, typename Reduce, typename Combine>
+    requires std::is_invocable_r_v<U, Combine &, U, U>
+Task<Func, U> ParallelReduce(ThreadPool &pool, const R &input, U identity, Reduce reduce, Combine combine, std::size_t grain = 0) {
+    return ParallelReduce<Func>(pool, parallel_detail::ConstSpan(input), std::move(identity), reduce, combine, grain);
+}
+
+template <template <typename> class Func, parallel_detail::ContiguousInput R, typename Reduce>
+auto ParallelReduce(ThreadPool &pool, const R &input, std::ranges::range_value_t<R> identity, Reduce reduce, std::size_t grain = 0) {
+    return ParallelReduce<Func>(pool, parallel_detail::ConstSpan(input), std::move(identity), reduce, reduce, grain);
+}
+
+// Resolves with true once f has been called on every element.
+template <template <typename> class Func, typename T, typename F>
+Task<Func, bool> ParallelForEach(ThreadPool &pool, std::span<T> input, F f, std::size_t grain = 0) {
+    using Handler = typename Task<Func, bool>::Handler;
+
+    return Task<Func, bool>([&pool, input, f, grain](const Handler &handler) {
+        parallel_detail::ForChunks(pool, input.size(), parallel_detail::Grain<T>(grain),
+            [input, f](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; ++i) {
+                    f(input[i]);
+                }
+            },
+            [handler]() {
+                handler(true);
+            });
+    });
+}
+
+template <template <typename> class Func, parallel_detail::ContiguousInput R, typename F>
+Task<Func, bool> ParallelForEach(ThreadPool &pool, R &input, F f, std::size_t grain = 0) {
+    using T = std::remove_reference_t<std::ranges::range_reference_t<R>>;
+    return ParallelForEach<Func>(pool, std::span<T>(std::ranges::data(input), std::ranges::size(input)), f, grain);
+}
@@ -0,0 +1,62 @@
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include "./parallels.h"
+#include "./parallel.h"
+#include "./thread-pool.h"
+#include "./thread-log.h"
+
+static double transform(int x) {
+    double y = x;
+    for (int i = 0; i < 20; ++i) {
+        y = std::sqrt(y + i);
+    }
+    return y;
+}
+
+void ParallelsDemo::run() {
+    ThreadPool pool;
+
+    std::vector<int> items(1 << 20);
+    std::iota(items.begin(), items.end(), 0);
+
+    // Single thread
+    auto start = std::chrono::steady_clock::now();
+    std::vector<double> expected(items.size());
+    for (std::size_t i = 0; i < items.size(); ++i) {
+        expected[i] = transform(items[i]);
+    }
+    std::chrono::duration<double, std::milli> serialMs = std::chrono::steady_clock::now() - start;
+
+    // Map
+    start = std::chrono::steady_clock::now();
+    std::vector<double> mapped;
+    ParallelMap<std::function>(pool, items, transform).Run([&mapped](std::vector<double> &&result) {
+        mapped = std::move(result);
+    });
+    pool.join();
+    std::chrono::duration<double, std::milli> parallelMs = std::chrono::steady_clock::now() - start;
+
+    threadLog("Map matches", mapped == expected, "serial ms", serialMs.count(), "parallel ms", parallelMs.count(), "threads", pool.size());
+
+    // Reduce
+    ParallelReduce<std::function>(pool, items, 0L, [](long acc, int x) { return acc + x; }, [](long a, long b) { return a + b; })
+        .Run([](long &&sum) { threadLog("Sum", sum); });
+
+    ParallelReduce<std::function>(pool, mapped, 0.0, [](double a, double b) { return std::max(a, b); })
+        .Run([](double &&max) { threadLog("Max", max); });
+
+    // The reductions above still read items; finish them before writing
+    pool.join();
+
+    // For each
+    ParallelForEach<std::function>(pool, items, [](int &x) { x *= 2; }, 4096)
+        .Then<long>([&pool, &items](bool &&) {
+            return ParallelReduce<std::function>(pool, items, 0L, [](long acc, int x) { return acc + x; }, [](long a, long b) { return a + b; });
+        })
+        .Run([](long &&sum) { threadLog("Sum after doubling", sum); });
+
+    pool.join();
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+class ParallelsDemo {
+public:
+    static constexpr const char* name = "Parallels";
+    static void run();
+};
@@ -0,0 +1,65 @@
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+#include "./priority-lanes.h"
+#include "./threaded-runner.h"
+#include "./thread-log.h"
+
+std::ostream &operator << (std::ostream &ostm, const LaneStats &stats) {
+    return ostm << "LaneStats(dispatched=" << stats.dispatched
+                << ", maxQueueLength=" << stats.maxQueueLength
+                << ", meanWaitUs=" << (stats.dispatched > 0 ? stats.totalWaitUs / stats.dispatched : 0)
+                << ", p99WaitUs<=" << stats.p99WaitUs
+                << ", maxWaitUs=" << stats.maxWaitUs
+                << ")";
+}
+
+static void busyFor(std::chrono::microseconds us) {
+    auto until = std::chrono::steady_clock::now() + us;
+    while (std::chrono::steady_clock::now() < until) { }
+}
+
+void PriorityLanesDemo::run() {
+    // One worker, so every lane competes for the same thread
+    ThreadedRunner runner(1);
+
+    // Saturate the background lane
+    for (int i = 0; i < 2000; ++i) {
+        runner.delay(0, []() { busyFor(std::chrono::microseconds(200)); }, Lane::Background);
+    }
+
+    // Interactive and normal work keeps arriving on top of it
+    for (int i = 0; i < 50; ++i) {
+        runner.delay(5 * i, []() { busyFor(std::chrono::microseconds(50)); }, Lane::Interactive);
+        runner.delay(5 * i, []() { busyFor(std::chrono::microseconds(200)); }, Lane::Normal);
+    }
+
+    runner.join();
+
+    threadLog("Interactive", runner.stats(Lane::Interactive));
+    threadLog("Normal", runner.stats(Lane::Normal));
+    threadLog("Background", runner.stats(Lane::Background));
+
+    // Deadlines are served earliest first within a lane. Hold the worker
+    // until all three are queued, so the order does not depend on timing.
+    std::atomic<bool> started{false};
+    std::atomic<bool> released{false};
+    runner.delay(0, [&started, &released]() {
+        started = true;
+        started.notify_one();
+        released.wait(false);
+    }, Lane::Background);
+    started.wait(false);
+
+    std::vector<int> order;
+    auto now = ThreadedRunner::Clock::now();
+    for (int i = 3; i >= 1; --i) {
+        runner.delay(0, [&order, i]() { order.push_back(i); }, Lane::Interactive, now + std::chrono::milliseconds(i));
+    }
+    released = true;
+    released.notify_one();
+
+    runner.join();
+    threadLog("Deadline order", order[0], order[1], order[2]);
+}
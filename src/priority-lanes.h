@@ -0,0 +1,7 @@
+#pragma once
+
+class PriorityLanesDemo {
+public:
+    static constexpr const char* name = "PriorityLanes";
+    static void run();
+};
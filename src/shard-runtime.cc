@@ -0,0 +1,313 @@
+#include <algorithm>
+
+#include "./shard-runtime.h"
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+static thread_local Shard *currentShard = nullptr;
+
+Shard::Shard(ShardRuntime &runtime, int index, int cpu, int shards, std::size_t mailboxCapacity)
+    : runtime(runtime)
+    , index(index)
+    , cpu(cpu)
+    , ready(&pool)
+    , timers(std::greater<Timer>(), std::pmr::vector<Timer>(&pool))
+    , overflow(shards) {
+    for (int i = 0; i < shards; ++i) {
+        inbox.push_back(std::make_unique<SpscQueue<Callback>>(mailboxCapacity));
+    }
+}
+
+int Shard::id() const {
+    return index;
+}
+
+std::pmr::memory_resource *Shard::allocator() {
+    return &pool;
+}
+
+void Shard::post(Callback &&callback) {
+    ready.push_back(std::move(callback));
+}
+
+void Shard::delay(int ms, Callback &&callback) {
+    timers.push({ Clock::now() + std::chrono::milliseconds(ms), timerSequence++, std::move(callback) });
+}
+
+void Shard::send(Shard &target, Callback &&callback) {
+    sent.fetch_add(1, std::memory_order_relaxed);
+    // Keep FIFO order per target: once something overflowed, queue behind it.
+    if (!overflow[target.index].empty() || !target.inbox[index]->push(std::move(callback))) {
+        overflow[target.index].push_back(std::move(callback));
+        ++overflowCount;
+        return;
+    }
+    target.wake();
+}
+
+void Shard::wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(parkMutex);
+        wakeup.notify_one();
+    }
+}
+
+bool Shard::flushOverflow() {
+    if (overflowCount == 0) {
+        return false;
+    }
+    bool flushed = false;
+    for (std::size_t i = 0; i < overflow.size(); ++i) {
+        Shard &target = *runtime.shards[i];
+        bool pushed = false;
+        while (!overflow[i].empty() && target.inbox[index]->push(std::move(overflow[i].front()))) {
+            overflow[i].pop_front();
+            --overflowCount;
+            pushed = true;
+        }
+        if (pushed) {
+            target.wake();
+            flushed = true;
+        }
+    }
+    return flushed;
+}
+
+bool Shard::drain() {
+    bool drained = false;
+    if (hasExternal.load(std::memory_order_acquire)) {
+        std::deque<Callback> batch;
+        {
+            std::lock_guard<std::mutex> lock(externalMutex);
+            batch.swap(external);
+            hasExternal.store(false, std::memory_order_relaxed);
+        }
+        for (Callback &callback : batch) {
+            ready.push_back(std::move(callback));
+        }
+        received.fetch_add((long)batch.size(), std::memory_order_relaxed);
+        drained = drained || !batch.empty();
+    }
+
+    Callback callback;
+    for (auto &mailbox : inbox) {
+        while (mailbox->pop(callback)) {
+            ready.push_back(std::move(callback));
+            received.fetch_add(1, std::memory_order_relaxed);
+            drained = true;
+        }
+    }
+    return drained;
+}
+
+bool Shard::runReady() {
+    // Only run what is queued now, so mail and timers are not starved by
+    // work that keeps posting more work.
+    std::size_t n = ready.size();
+    for (std::size_t i = 0; i < n; ++i) {
+        Callback callback = std::move(ready.front());
+        ready.pop_front();
+        callback();
+    }
+    return n > 0;
+}
+
+bool Shard::fireTimers() {
+    bool fired = false;
+    Clock::time_point now = Clock::now();
+    while (!timers.empty() && timers.top().deadline <= now) {
+        ready.push_back(std::move(const_cast<Timer &>(timers.top()).callback));
+        timers.pop();
+        fired = true;
+    }
+    return fired;
+}
+
+bool Shard::hasMail() {
+    if (hasExternal.load(std::memory_order_acquire)) {
+        return true;
+    }
+    for (auto &mailbox : inbox) {
+        if (!mailbox->empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Shard::park() {
+    std::unique_lock<std::mutex> lock(parkMutex);
+    sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (hasMail() || runtime.stopping.load(std::memory_order_acquire)) {
+        sleeping.store(false, std::memory_order_relaxed);
+        return;
+    }
+
+    if (overflowCount > 0) {
+        // A target mailbox is full; back off briefly and retry.
+        wakeup.wait_for(lock, std::chrono::microseconds(100));
+    } else if (timers.empty()) {
+        idle.store(true, std::memory_order_release);
+        wakeup.wait(lock);
+    } else {
+        wakeup.wait_until(lock, timers.top().deadline);
+    }
+    idle.store(false, std::memory_order_release);
+    sleeping.store(false, std::memory_order_relaxed);
+}
+
+void Shard::loop() {
+#ifdef __linux__
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        sched_setaffinity(0, sizeof(set), &set);
+    }
+#endif
+    currentShard = this;
+
+    while (true) {
+        bool busy = drain();
+        busy = flushOverflow() || busy;
+        busy = fireTimers() || busy;
+        busy = runReady() || busy;
+        if (!busy && ready.empty()) {
+            if (runtime.stopping.load(std::memory_order_acquire)) {
+                break;
+            }
+            park();
+        }
+    }
+    currentShard = nullptr;
+}
+
+std::vector<int> ShardRuntime::availableCpus() {
+    std::vector<int> cpus;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+#endif
+    if (cpus.empty()) {
+        int n = std::max(1u, std::thread::hardware_concurrency());
+        for (int cpu = 0; cpu < n; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+ShardRuntime::ShardRuntime(int size, bool pin, std::size_t mailboxCapacity) {
+    std::vector<int> cpus = availableCpus();
+    if (size <= 0) {
+        size = (int)cpus.size();
+    }
+    for (int i = 0; i < size; ++i) {
+        int cpu = pin ? cpus[i % cpus.size()] : -1;
+        shards.push_back(std::make_unique<Shard>(*this, i, cpu, size, mailboxCapacity));
+    }
+    // Start the loops only once every shard exists, since they reach into
+    // each other's mailboxes.
+    for (auto &shard : shards) {
+        shard->thread = std::thread([shard = shard.get()]() { shard->loop(); });
+    }
+}
+
+ShardRuntime::~ShardRuntime() {
+    if (!joined) {
+        stopping.store(true, std::memory_order_release);
+        for (auto &shard : shards) {
+            shard->wake();
+        }
+        for (auto &shard : shards) {
+            shard->thread.join();
+        }
+    }
+}
+
+int ShardRuntime::size() const {
+    return (int)shards.size();
+}
+
+Shard &ShardRuntime::shard(int index) {
+    return *shards[index];
+}
+
+Shard *ShardRuntime::current() {
+    return currentShard;
+}
+
+void ShardRuntime::submit(int index, Shard::Callback &&callback) {
+    Shard &target = *shards[index];
+    Shard *self = currentShard;
+    if (self == &target) {
+        target.post(std::move(callback));
+    } else if (self != nullptr && &self->runtime == this) {
+        self->send(target, std::move(callback));
+    } else {
+        externalSent.fetch_add(1, std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(target.externalMutex);
+            target.external.push_back(std::move(callback));
+            target.hasExternal.store(true, std::memory_order_release);
+        }
+        target.wake();
+    }
+}
+
+void ShardRuntime::delay(int index, int ms, Shard::Callback &&callback) {
+    if (currentShard == shards[index].get()) {
+        shards[index]->delay(ms, std::move(callback));
+        return;
+    }
+    submit(index, [shard = shards[index].get(), ms, callback = std::move(callback)]() mutable {
+        shard->delay(ms, std::move(callback));
+    });
+}
+
+bool ShardRuntime::quiescent(long &sentTotal, long &receivedTotal) {
+    bool allIdle = true;
+    sentTotal = externalSent.load(std::memory_order_acquire);
+    receivedTotal = 0;
+    for (auto &shard : shards) {
+        allIdle = allIdle && shard->idle.load(std::memory_order_acquire);
+        sentTotal += shard->sent.load(std::memory_order_acquire);
+        receivedTotal += shard->received.load(std::memory_order_acquire);
+    }
+    return allIdle;
+}
+
+void ShardRuntime::join() {
+    if (joined) {
+        return;
+    }
+    // Two consecutive waves that see every shard idle and the same balanced
+    // message counts mean nothing is left in flight.
+    while (true) {
+        long sent1, received1, sent2, received2;
+        if (quiescent(sent1, received1) && quiescent(sent2, received2)
+            && sent1 == received1 && sent1 == sent2 && received1 == received2) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    stopping.store(true, std::memory_order_release);
+    for (auto &shard : shards) {
+        shard->wake();
+    }
+    for (auto &shard : shards) {
+        shard->thread.join();
+    }
+    joined = true;
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "./spsc-queue.h"
+
+class ShardRuntime;
+
+// One pinned event loop. Everything in a shard (ready queue, timers,
+// allocator) is touched only by its own thread; other shards reach it
+// through per-sender SPSC mailboxes.
+class Shard {
+public:
+    using Callback = std::function<void()>;
+    using Clock = std::chrono::steady_clock;
+
+private:
+    friend class ShardRuntime;
+
+    struct Timer {
+        Clock::time_point deadline;
+        long sequence;
+        Callback callback;
+
+        bool operator > (const Timer &timer) const {
+            return deadline != timer.deadline ? deadline > timer.deadline : sequence > timer.sequence;
+        }
+    };
+
+    ShardRuntime &runtime;
+    const int index;
+    const int cpu;
+
+    std::pmr::unsynchronized_pool_resource pool;
+    std::pmr::deque<Callback> ready;
+    std::priority_queue<Timer, std::pmr::vector<Timer>, std::greater<Timer>> timers;
+    long timerSequence = 0;
+
+    // inbox[from] is written only by shard `from`; overflow[to] holds what
+    // this shard could not fit into a full mailbox of shard `to`.
+    std::vector<std::unique_ptr<SpscQueue<Callback>>> inbox;
+    std::vector<std::deque<Callback>> overflow;
+    std::size_t overflowCount = 0;
+
+    // Submissions from threads outside the runtime.
+    std::mutex externalMutex;
+    std::deque<Callback> external;
+    std::atomic<bool> hasExternal{false};
+
+    // Parking and termination detection.
+    std::mutex parkMutex;
+    std::condition_variable wakeup;
+    std::atomic<bool> sleeping{false};
+    std::atomic<bool> idle{false};
+    alignas(64) std::atomic<long> sent{0};
+    std::atomic<long> received{0};
+
+    std::thread thread;
+
+    void loop();
+    bool drain();
+    bool flushOverflow();
+    bool runReady();
+    bool fireTimers();
+    bool hasMail();
+    void park();
+    void wake();
+    void send(Shard &target, Callback &&callback);
+public:
+    Shard(ShardRuntime &runtime, int index, int cpu, int shards, std::size_t mailboxCapacity);
+
+    Shard(const Shard &) = delete;
+    Shard &operator = (const Shard &) = delete;
+
+    int id() const;
+    // Shard-local allocator; only use it from this shard's thread.
+    std::pmr::memory_resource *allocator();
+
+    // Must be called from this shard's thread; use ShardRuntime otherwise.
+    void post(Callback &&callback);
+    void delay(int ms, Callback &&callback);
+};
+
+// Shared-nothing runtime: one event-loop thread per core, pinned with
+// sched_setaffinity. Work stays on the shard it was submitted to.
+class ShardRuntime {
+private:
+    friend class Shard;
+
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::atomic<long> externalSent{0};
+    std::atomic<bool> stopping{false};
+    bool joined = false;
+
+    bool quiescent(long &sent, long &received);
+public:
+    // shards <= 0 means one per CPU this process may run on.
+    explicit ShardRuntime(int shards = 0, bool pin = true, std::size_t mailboxCapacity = 1024);
+    ~ShardRuntime();
+
+    ShardRuntime(const ShardRuntime &) = delete;
+    ShardRuntime &operator = (const ShardRuntime &) = delete;
+
+    int size() const;
+    Shard &shard(int index);
+    // The shard running the calling thread, or nullptr outside the runtime.
+    static Shard *current();
+
+    // Safe from any thread. From a shard thread this goes through that
+    // shard's SPSC mailbox to the target, otherwise through a locked queue.
+    void submit(int shard, Shard::Callback &&callback);
+    void delay(int shard, int ms, Shard::Callback &&callback);
+
+    // Wait until every shard is idle with empty mailboxes and no timers,
+    // then stop the event loops.
+    void join();
+
+    static std::vector<int> availableCpus();
+};
@@ -0,0 +1,102 @@
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include "./shards.h"
+#include "./shard-runtime.h"
+#include "./thread-pool.h"
+#include "./thread-log.h"
+
+// Each chain hops `hops` times, doing a little CPU work per hop and moving
+// to the next shard every `crossEvery` hops.
+struct Workload {
+    int chains;
+    int hops;
+    int crossEvery;
+};
+
+static unsigned spin(unsigned x) {
+    for (int i = 0; i < 200; ++i) {
+        x = x * 1664525u + 1013904223u;
+    }
+    return x;
+}
+
+static void shardHop(ShardRuntime &runtime, const Workload &load, int hop, unsigned x, std::atomic<unsigned> &sink) {
+    x = spin(x);
+    if (hop == load.hops) {
+        sink.fetch_xor(x, std::memory_order_relaxed);
+        return;
+    }
+    int home = ShardRuntime::current()->id();
+    int next = (hop % load.crossEvery == 0) ? (home + 1) % runtime.size() : home;
+    runtime.submit(next, [&runtime, &load, hop, x, &sink]() {
+        shardHop(runtime, load, hop + 1, x, sink);
+    });
+}
+
+static void poolHop(ThreadPool &pool, const Workload &load, int hop, unsigned x, std::atomic<unsigned> &sink) {
+    x = spin(x);
+    if (hop == load.hops) {
+        sink.fetch_xor(x, std::memory_order_relaxed);
+        return;
+    }
+    pool.submit([&pool, &load, hop, x, &sink]() {
+        poolHop(pool, load, hop + 1, x, sink);
+    });
+}
+
+template <typename F>
+static double hopsPerSecond(const Workload &load, int cores, F &&run) {
+    auto start = std::chrono::steady_clock::now();
+    run();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return (double)load.chains * cores * load.hops / elapsed.count();
+}
+
+void ShardsDemo::run() {
+    // Cross-shard messages and timers
+    {
+        ShardRuntime runtime;
+        for (int i = 0; i < runtime.size(); ++i) {
+            runtime.delay(i, 100 * (i + 1), [&runtime, i]() {
+                threadLog("Timer fired on shard", ShardRuntime::current()->id());
+                runtime.submit((i + 1) % runtime.size(), [i]() {
+                    threadLog("Message from shard", i, "handled on shard", ShardRuntime::current()->id());
+                });
+            });
+        }
+        runtime.join();
+    }
+
+    // Throughput against a shared pool of the same size
+    Workload load{ 64, 2000, 8 };
+    int maxCores = (int)ShardRuntime::availableCpus().size();
+    for (int cores = 1; ; cores = std::min(cores * 2, maxCores)) {
+        std::atomic<unsigned> sink{0};
+
+        double sharded = hopsPerSecond(load, cores, [&]() {
+            ShardRuntime runtime(cores);
+            for (int i = 0; i < cores; ++i) {
+                for (int c = 0; c < load.chains; ++c) {
+                    runtime.submit(i, [&runtime, &load, c, &sink]() { shardHop(runtime, load, 1, c, sink); });
+                }
+            }
+            runtime.join();
+        });
+
+        double pooled = hopsPerSecond(load, cores, [&]() {
+            ThreadPool pool(cores);
+            for (int i = 0; i < cores * load.chains; ++i) {
+                pool.submit([&pool, &load, i, &sink]() { poolHop(pool, load, 1, i, sink); });
+            }
+            pool.join();
+        });
+
+        threadLog("Cores", cores, "sharded hops/s", (long)sharded, "shared pool hops/s", (long)pooled);
+        if (cores == maxCores) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+class ShardsDemo {
+public:
+    static constexpr const char* name = "Shards";
+    static void run();
+};
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two.
+template <typename T>
+class SpscQueue {
+private:
+    std::vector<T> slots;
+    const std::size_t mask;
+
+    alignas(64) std::atomic<std::size_t> head{0};  // next slot to pop, owned by the consumer
+    std::size_t cachedTail = 0;
+
+    alignas(64) std::atomic<std::size_t> tail{0};  // next slot to push, owned by the producer
+    std::size_t cachedHead = 0;
+
+    static std::size_t roundUp(std::size_t n) {
+        std::size_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+public:
+    explicit SpscQueue(std::size_t capacity): slots(roundUp(capacity)), mask(slots.size() - 1) { }
+
+    SpscQueue(const SpscQueue &) = delete;
+    SpscQueue &operator = (const SpscQueue &) = delete;
+
+    // Producer side. Leaves value untouched and returns false when full.
+    bool push(T &&value) {
+        std::size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead == slots.size()) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead == slots.size()) {
+                return false;
+            }
+        }
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side.
+    bool pop(T &value) {
+        std::size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[h & mask]);
+        slots[h & mask] = T();
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Safe from either side; may be stale by the time it returns.
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "./task.h"
+
+// Thrown by SyncWait when every copy of the handler was destroyed without
+// being called, so the task can never complete.
+class TaskAbandoned : public std::runtime_error {
+public:
+    TaskAbandoned(): std::runtime_error("Task dropped its handler without resolving") { }
+};
+
+namespace sync_wait_detail {
+
+enum State : int { Pending, Resolved, Abandoned };
+
+template <typename T>
+struct Slot {
+    std::atomic<int> state{Pending};
+    std::optional<T> value;
+};
+
+// Owned by the handler; marks the slot abandoned if the last copy of the
+// handler goes away unresolved.
+template <typename T>
+class Completion {
+private:
+    std::shared_ptr<Slot<T>> slot_;
+    std::atomic<bool> done_{false};
+
+    void Finish(int state) {
+        slot_->state.store(state, std::memory_order_release);
+        slot_->state.notify_one();
+    }
+public:
+    explicit Completion(std::shared_ptr<Slot<T>> slot): slot_(std::move(slot)) { }
+
+    ~Completion() {
+        if (!done_.load(std::memory_order_acquire)) {
+            Finish(Abandoned);
+        }
+    }
+
+    void Resolve(T &&t) {
+        if (!done_.exchange(true, std::memory_order_acq_rel)) {
+            slot_->value.emplace(std::move(t));
+            Finish(Resolved);
+        }
+    }
+};
+
+inline void CpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+constexpr int SpinCount = 2000;
+
+}
+
+// Runs the task and blocks the calling thread until it resolves, returning
+// the value. Spins briefly for tasks that finish quickly, then sleeps in
+// std::atomic::wait; there is no mutex on either path.
+//
+// Must not be called from a thread the task needs in order to complete
+// (for example the only worker of its pool).
+template <template <typename> class Func, typename T>
+T SyncWait(const Task<Func, T> &task) {
+    using namespace sync_wait_detail;
+
+    auto slot = std::make_shared<Slot<T>>();
+    {
+        auto completion = std::make_shared<Completion<T>>(slot);
+        typename Task<Func, T>::Handler handler = [completion](T &&t) {
+            completion->Resolve(std::move(t));
+        };
+        task.Run(handler);
+    }
+
+    int state = slot->state.load(std::memory_order_acquire);
+    for (int i = 0; i < SpinCount && state == Pending; ++i) {
+        CpuRelax();
+        state = slot->state.load(std::memory_order_acquire);
+    }
+    while (state == Pending) {
+        slot->state.wait(Pending, std::memory_order_acquire);
+        state = slot->state.load(std::memory_order_acquire);
+    }
+
+    if (state == Abandoned) {
+        throw TaskAbandoned();
+    }
+    return std::move(*slot->value);
+}
@@ -0,0 +1,49 @@
+#include <chrono>
+#include <vector>
+
+#include "./sync-waits.h"
+#include "./sync-wait.h"
+#include "./parallel.h"
+#include "./task.h"
+#include "./thread-pool.h"
+#include "./threaded-runner.h"
+#include "./thread-log.h"
+
+template <typename T>
+using Tk = Task<std::function, T>;
+
+template <typename T>
+using Hdl = typename Tk<T>::Handler;
+
+void SyncWaitsDemo::run() {
+    ThreadedRunner threadedRunner;
+    auto runner = [&threadedRunner](int ms, std::function<void()> &&callback) {
+        threadedRunner.delay(ms, std::move(callback));
+    };
+
+    // Resolves on the calling thread, caught by the spin phase
+    threadLog("Immediate", SyncWait(Tk<int>::Resolve(42)));
+
+    // Resolves on a runner thread, waits only for this task
+    threadedRunner.delay(3000, []() { threadLog("Unrelated work done"); });
+    auto start = std::chrono::steady_clock::now();
+    int delayed = SyncWait(Tk<int>::Resolve(7).DelayedFor(runner, 200));
+    std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - start;
+    threadLog("Delayed", delayed, "waited ms", waited.count());
+
+    // Bridging into pool-based Tasks
+    ThreadPool pool;
+    std::vector<int> items(100000, 1);
+    long sum = SyncWait(ParallelReduce<std::function>(pool, items, 0L,
+        [](long acc, int x) { return acc + x; }, [](long a, long b) { return a + b; }));
+    threadLog("Sum", sum);
+
+    // A task that drops its handler can never resolve
+    try {
+        SyncWait(Tk<int>([](const Hdl<int> &) { }));
+    } catch (const TaskAbandoned &e) {
+        threadLog("Abandoned", e.what());
+    }
+
+    threadedRunner.join();
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+class SyncWaitsDemo {
+public:
+    static constexpr const char* name = "SyncWaits";
+    static void run();
+};
@@ -0,0 +1,328 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "./task.h"
+
+// Builder for a DAG of Tasks. Each node receives the results of its
+// dependencies, in the order they were declared, and returns the Task that
+// produces its own result. Build() checks for cycles once; Run() then
+// starts every node as soon as its last input is ready, preferring nodes
+// with the longest remaining path when the concurrency limit is reached.
+template <template <typename> class Func, typename T>
+class TaskGraph {
+public:
+    using NodeId = int;
+    using Inputs = std::vector<T>;
+    using NodeFunc = Func<Task<Func, T>(Inputs &&)>;
+
+    struct NodeTiming {
+        std::string name;
+        long long startUs;
+        long long endUs;
+        int remainingPath;
+        bool critical;
+    };
+
+    struct Result {
+        std::vector<T> values;
+        std::vector<NodeTiming> timings;
+
+        void Print(std::ostream &ostm) const {
+            for (const NodeTiming &timing : timings) {
+                ostm << (timing.critical ? "* " : "  ")
+                     << timing.name
+                     << ": start " << timing.startUs << "us"
+                     << ", end " << timing.endUs << "us"
+                     << ", took " << timing.endUs - timing.startUs << "us"
+                     << ", remaining path " << timing.remainingPath
+                     << std::endl;
+            }
+        }
+    };
+
+private:
+    struct Node {
+        std::string name_;
+        NodeFunc func_;
+        int cost_;
+        std::vector<NodeId> deps_;
+        std::vector<NodeId> dependents_;
+        int remainingPath_ = 0;
+        bool critical_ = false;
+    };
+
+    using Nodes = std::vector<Node>;
+
+    struct RunState {
+        using Clock = std::chrono::steady_clock;
+
+        std::shared_ptr<const Nodes> nodes_;
+        typename Task<Func, Result>::Handler handler_;
+        int maxConcurrency_;
+        Clock::time_point start_;
+
+        std::unique_ptr<std::atomic<int>[]> inDegree_;
+        std::vector<std::optional<T>> results_;
+        std::vector<NodeTiming> timings_;
+        std::atomic<int> remaining_;
+
+        std::mutex mutex_;
+        std::vector<NodeId> ready_;
+        int running_ = 0;
+
+        RunState(std::shared_ptr<const Nodes> nodes, const typename Task<Func, Result>::Handler &handler, int maxConcurrency)
+            : nodes_(std::move(nodes))
+            , handler_(handler)
+            , maxConcurrency_(maxConcurrency)
+            , start_(Clock::now())
+            , inDegree_(new std::atomic<int>[nodes_->size()])
+            , results_(nodes_->size())
+            , timings_(nodes_->size())
+            , remaining_((int)nodes_->size()) {
+            for (std::size_t i = 0; i < nodes_->size(); ++i) {
+                const Node &node = (*nodes_)[i];
+                inDegree_[i].store((int)node.deps_.size(), std::memory_order_relaxed);
+                timings_[i] = { node.name_, 0, 0, node.remainingPath_, node.critical_ };
+            }
+        }
+
+        long long Elapsed() const {
+            return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start_).count();
+        }
+
+        // Max-heap on remaining path; ties go to the node declared first.
+        bool Before(NodeId a, NodeId b) const {
+            int pa = (*nodes_)[a].remainingPath_;
+            int pb = (*nodes_)[b].remainingPath_;
+            return pa != pb ? pa < pb : a > b;
+        }
+    };
+
+    Nodes nodes_;
+    std::shared_ptr<const Nodes> built_;
+
+    static void Enqueue(const std::shared_ptr<RunState> &state, NodeId id) {
+        state->ready_.push_back(id);
+        std::push_heap(state->ready_.begin(), state->ready_.end(), [&state](NodeId a, NodeId b) {
+            return state->Before(a, b);
+        });
+    }
+
+    // Launches ready nodes from a loop. A node that resolves synchronously
+    // calls back into Dispatch on the same thread; that nested call returns
+    // at once and the outer loop picks up whatever became ready, so stack
+    // depth stays constant however long the chain.
+    static void Dispatch(const std::shared_ptr<RunState> &state) {
+        thread_local const RunState *draining = nullptr;
+        if (draining == state.get()) {
+            return;
+        }
+
+        struct Draining {
+            const RunState *outer_;
+            explicit Draining(const RunState *state): outer_(draining) { draining = state; }
+            ~Draining() { draining = outer_; }
+        } guard(state.get());
+
+        while (true) {
+            NodeId id;
+            {
+                std::lock_guard<std::mutex> lock(state->mutex_);
+                if (state->ready_.empty() || (state->maxConcurrency_ > 0 && state->running_ >= state->maxConcurrency_)) {
+                    return;
+                }
+                std::pop_heap(state->ready_.begin(), state->ready_.end(), [&state](NodeId a, NodeId b) {
+                    return state->Before(a, b);
+                });
+                id = state->ready_.back();
+                state->ready_.pop_back();
+                if (state->maxConcurrency_ > 0) {
+                    ++state->running_;
+                }
+            }
+            Launch(state, id);
+        }
+    }
+
+    static void Launch(const std::shared_ptr<RunState> &state, NodeId id) {
+        const Node &node = (*state->nodes_)[id];
+        Inputs inputs;
+        inputs.reserve(node.deps_.size());
+        for (NodeId dep : node.deps_) {
+            inputs.push_back(*state->results_[dep]);
+        }
+
+        state->timings_[id].startUs = state->Elapsed();
+        node.func_(std::move(inputs)).Run([state, id](T &&t) {
+            state->timings_[id].endUs = state->Elapsed();
+            state->results_[id].emplace(std::move(t));
+
+            std::vector<NodeId> ready;
+            for (NodeId dependent : (*state->nodes_)[id].dependents_) {
+                if (state->inDegree_[dependent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    ready.push_back(dependent);
+                }
+            }
+            // The lock only guards the ready heap and the running count, which
+            // is not tracked without a concurrency limit.
+            if (!ready.empty() || state->maxConcurrency_ > 0) {
+                std::lock_guard<std::mutex> lock(state->mutex_);
+                if (state->maxConcurrency_ > 0) {
+                    --state->running_;
+                }
+                for (NodeId dependent : ready) {
+                    Enqueue(state, dependent);
+                }
+            }
+            Dispatch(state);
+
+            if (state->remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                Result result;
+                for (std::optional<T> &value : state->results_) {
+                    result.values.push_back(std::move(*value));
+                }
+                result.timings = std::move(state->timings_);
+                state->handler_(std::move(result));
+            }
+        });
+    }
+
+    // Nodes Kahn's algorithm could not order are on a cycle or downstream of
+    // one; keep only those that can reach themselves.
+    std::string CycleNames(const std::vector<int> &inDegree) const {
+        std::string names;
+        for (std::size_t i = 0; i < nodes_.size(); ++i) {
+            if (inDegree[i] == 0) {
+                continue;
+            }
+            std::vector<bool> seen(nodes_.size());
+            std::vector<NodeId> stack(nodes_[i].dependents_);
+            bool cyclic = false;
+            while (!stack.empty() && !cyclic) {
+                NodeId id = stack.back();
+                stack.pop_back();
+                if (id == (NodeId)i) {
+                    cyclic = true;
+                } else if (!seen[id] && inDegree[id] > 0) {
+                    seen[id] = true;
+                    stack.insert(stack.end(), nodes_[id].dependents_.begin(), nodes_[id].dependents_.end());
+                }
+            }
+            if (cyclic) {
+                names += (names.empty() ? "" : ", ") + nodes_[i].name_;
+            }
+        }
+        return names;
+    }
+
+public:
+    // Dependencies must already exist; use AddDependency for anything else.
+    NodeId AddNode(std::string name, NodeFunc func, std::vector<NodeId> deps = {}, int cost = 1) {
+        NodeId id = (NodeId)nodes_.size();
+        nodes_.push_back({ std::move(name), std::move(func), cost, {}, {} });
+        built_.reset();
+        for (NodeId dep : deps) {
+            AddDependency(id, dep);
+        }
+        return id;
+    }
+
+    void AddDependency(NodeId node, NodeId dep) {
+        if (node < 0 || node >= (NodeId)nodes_.size() || dep < 0 || dep >= (NodeId)nodes_.size()) {
+            throw std::out_of_range("TaskGraph: unknown node id");
+        }
+        nodes_[node].deps_.push_back(dep);
+        nodes_[dep].dependents_.push_back(node);
+        built_.reset();
+    }
+
+    // Throws std::logic_error naming the nodes that lie on a cycle.
+    void Build() {
+        std::size_t n = nodes_.size();
+        std::vector<int> inDegree(n);
+        std::vector<NodeId> order;
+        for (std::size_t i = 0; i < n; ++i) {
+            inDegree[i] = (int)nodes_[i].deps_.size();
+            if (inDegree[i] == 0) {
+                order.push_back((NodeId)i);
+            }
+        }
+        for (std::size_t i = 0; i < order.size(); ++i) {
+            for (NodeId dependent : nodes_[order[i]].dependents_) {
+                if (--inDegree[dependent] == 0) {
+                    order.push_back(dependent);
+                }
+            }
+        }
+        if (order.size() != n) {
+            throw std::logic_error("TaskGraph: cycle through " + CycleNames(inDegree));
+        }
+
+        // Longest path from each node to a sink, counting its own cost.
+        for (auto it = order.rbegin(); it != order.rend(); ++it) {
+            Node &node = nodes_[*it];
+            int longest = 0;
+            for (NodeId dependent : node.dependents_) {
+                longest = std::max(longest, nodes_[dependent].remainingPath_);
+            }
+            node.remainingPath_ = node.cost_ + longest;
+            node.critical_ = false;
+        }
+
+        // Walk the critical path from its heaviest source.
+        NodeId current = -1;
+        for (NodeId id : order) {
+            if (nodes_[id].deps_.empty() && (current < 0 || nodes_[id].remainingPath_ > nodes_[current].remainingPath_)) {
+                current = id;
+            }
+        }
+        while (current >= 0) {
+            Node &node = nodes_[current];
+            node.critical_ = true;
+            current = -1;
+            for (NodeId dependent : node.dependents_) {
+                if (nodes_[dependent].remainingPath_ == node.remainingPath_ - node.cost_) {
+                    current = dependent;
+                    break;
+                }
+            }
+        }
+
+        built_ = std::make_shared<const Nodes>(nodes_);
+    }
+
+    // maxConcurrency <= 0 runs every ready node at once. The returned Task
+    // keeps its own copy of the graph.
+    Task<Func, Result> Run(int maxConcurrency = 0) const {
+        if (!built_) {
+            throw std::logic_error("TaskGraph: Build() before Run()");
+        }
+        using Handler = typename Task<Func, Result>::Handler;
+        return Task<Func, Result>([nodes = built_, maxConcurrency](const Handler &handler) {
+            auto state = std::make_shared<RunState>(nodes, handler, maxConcurrency);
+            if (nodes->empty()) {
+                handler(Result());
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> lock(state->mutex_);
+                for (std::size_t i = 0; i < nodes->size(); ++i) {
+                    if ((*nodes)[i].deps_.empty()) {
+                        Enqueue(state, (NodeId)i);
+                    }
+                }
+            }
+            Dispatch(state);
+        });
+    }
+};
@@ -0,0 +1,65 @@
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+
+#include "./task-graphs.h"
+#include "./task-graph.h"
+#include "./sync-wait.h"
+#include "./task.h"
+#include "./threaded-runner.h"
+#include "./thread-log.h"
+
+template <typename T>
+using Tk = Task<std::function, T>;
+
+using Graph = TaskGraph<std::function, int>;
+
+void TaskGraphsDemo::run() {
+    ThreadedRunner threadedRunner;
+    auto runner = [&threadedRunner](int ms, std::function<void()> &&callback) {
+        threadedRunner.delay(ms, std::move(callback));
+    };
+
+    // Sums its inputs plus `own` after `ms`
+    auto step = [runner](int own, int ms) {
+        return [runner, own, ms](Graph::Inputs &&inputs) {
+            int sum = std::accumulate(inputs.begin(), inputs.end(), own);
+            return Tk<int>::Resolve(sum).DelayedFor(runner, ms);
+        };
+    };
+
+    //   A -> B -> B2 -> B3 -> D
+    //   A -> C ------------> D
+    //   E (independent)
+    Graph graph;
+    auto a = graph.AddNode("A", step(1, 100));
+    auto b = graph.AddNode("B", step(2, 100), { a });
+    auto b2 = graph.AddNode("B2", step(3, 100), { b });
+    auto b3 = graph.AddNode("B3", step(4, 100), { b2 });
+    auto c = graph.AddNode("C", step(5, 100), { a });
+    graph.AddNode("E", step(6, 100));
+    graph.AddNode("D", step(7, 100), { b3, c });
+    graph.Build();
+
+    // With one slot, B's long chain goes ahead of C, and A ahead of E
+    auto result = SyncWait(graph.Run(1));
+    threadLog("D", result.values.back());
+    result.Print(std::cout);
+
+    result = SyncWait(graph.Run());
+    threadLog("Unbounded D", result.values.back());
+    result.Print(std::cout);
+
+    // Cycles are rejected when the graph is built
+    Graph cyclic;
+    auto x = cyclic.AddNode("X", step(1, 0));
+    auto y = cyclic.AddNode("Y", step(1, 0), { x });
+    cyclic.AddDependency(x, y);
+    try {
+        cyclic.Build();
+    } catch (const std::logic_error &e) {
+        threadLog("Rejected", e.what());
+    }
+
+    threadedRunner.join();
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+class TaskGraphsDemo {
+public:
+    static constexpr const char* name = "TaskGraphs";
+    static void run();
+};
@@ -3,6 +3,7 @@
 #include <chrono>
 #include <ctime>
 #include <iomanip>
+#include <thread>
 
 template <typename Arg, typename ...Args>
 void threadLog(Arg&& arg, Args&&... args) {
@@ -0,0 +1,58 @@
+#include "./thread-pool.h"
+
+ThreadPool::ThreadPool(int size) {
+    if (size < 1) {
+        size = 1;
+    }
+    for (int i = 0; i < size; ++i) {
+        threads.emplace_back([this]() { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (std::thread &thread : threads) {
+        thread.join();
+    }
+}
+
+int ThreadPool::size() const {
+    return (int)threads.size();
+}
+
+void ThreadPool::submit(std::function<void()> &&callback) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(callback));
+    }
+    workReady.notify_one();
+}
+
+void ThreadPool::join() {
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this]() { return queue.empty() && active == 0; });
+}
+
+void ThreadPool::work() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        workReady.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty()) {
+            return;
+        }
+        std::function<void()> callback = std::move(queue.front());
+        queue.pop_front();
+        ++active;
+        lock.unlock();
+        callback();
+        lock.lock();
+        --active;
+        if (active == 0 && queue.empty()) {
+            allDone.notify_all();
+        }
+    }
+}
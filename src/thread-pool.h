@@ -0,0 +1,34 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads sharing one mutex-protected FIFO.
+class ThreadPool {
+private:
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable allDone;
+    std::deque<std::function<void()>> queue;
+    std::vector<std::thread> threads;
+    int active = 0;
+    bool stopping = false;
+
+    void work();
+public:
+    explicit ThreadPool(int size = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator = (const ThreadPool &) = delete;
+
+    int size() const;
+    void submit(std::function<void()> &&callback);
+    // Wait until the queue is empty and no worker is busy, including work
+    // submitted by other work.
+    void join();
+};
@@ -1,20 +1,175 @@
+#include <algorithm>
+#include <bit>
+
 #include "./threaded-runner.h"
 #include "./thread-log.h"
 
+ThreadedRunner::ThreadedRunner(int workerCount, std::array<int, LaneCount> weights) {
+    for (int i = 0; i < LaneCount; ++i) {
+        lanes[i].weight = std::max(1, weights[i]);
+    }
+    for (int i = 0; i < std::max(1, workerCount); ++i) {
+        workers.emplace_back([this]() { work(); });
+    }
+}
+
+ThreadedRunner::~ThreadedRunner() {
+    join();
+    {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
 void ThreadedRunner::delay(int ms, std::function<void()> &&callback) {
-    threads.push_back(std::thread([ms, callback = std::move(callback)]() {
+    schedule(ms, Lane::Normal, Clock::time_point::max(), std::move(callback));
+}
+
+void ThreadedRunner::delay(int ms, std::function<void()> &&callback, Lane lane) {
+    schedule(ms, lane, Clock::time_point::max(), std::move(callback));
+}
+
+void ThreadedRunner::delay(int ms, std::function<void()> &&callback, Lane lane, Clock::time_point deadline) {
+    schedule(ms, lane, deadline, std::move(callback));
+}
+
+void ThreadedRunner::schedule(int ms, Lane lane, Clock::time_point deadline, std::function<void()> &&callback) {
+    if (ms <= 0) {
+        enqueue(lane, deadline, std::move(callback));
+        return;
+    }
+    // Callbacks may schedule more work, so delay can race with join.
+    std::lock_guard<std::mutex> lock(mutex);
+    threads.push_back(std::thread([this, ms, lane, deadline, callback = std::move(callback)]() mutable {
         // threadLog("Thread started");
         std::this_thread::sleep_for(std::chrono::milliseconds(ms));
-        callback();
+        enqueue(lane, deadline, std::move(callback));
     }));
 }
 
+void ThreadedRunner::enqueue(Lane lane, Clock::time_point deadline, std::function<void()> &&callback) {
+    {
+        std::lock_guard<std::mutex> lock(dispatchMutex);
+        LaneQueue &queue = lanes[(int)lane];
+        Ready ready{ Clock::now(), deadline, sequence++, std::move(callback) };
+        if (deadline == Clock::time_point::max()) {
+            queue.fifo.push_back(std::move(ready));
+        } else {
+            queue.deadlines.push_back(std::move(ready));
+            std::push_heap(queue.deadlines.begin(), queue.deadlines.end(), std::greater<Ready>());
+        }
+        queue.maxQueueLength = std::max(queue.maxQueueLength, queue.size());
+    }
+    workReady.notify_one();
+}
+
+// Smooth weighted round robin over the non-empty lanes. Called with
+// dispatchMutex held.
+bool ThreadedRunner::pick(Ready &ready) {
+    LaneQueue *chosen = nullptr;
+    int total = 0;
+    for (LaneQueue &queue : lanes) {
+        if (queue.size() == 0) {
+            continue;
+        }
+        queue.current += queue.weight;
+        total += queue.weight;
+        if (chosen == nullptr || queue.current > chosen->current) {
+            chosen = &queue;
+        }
+    }
+    if (chosen == nullptr) {
+        return false;
+    }
+    chosen->current -= total;
+
+    if (!chosen->deadlines.empty()) {
+        std::pop_heap(chosen->deadlines.begin(), chosen->deadlines.end(), std::greater<Ready>());
+        ready = std::move(chosen->deadlines.back());
+        chosen->deadlines.pop_back();
+    } else {
+        ready = std::move(chosen->fifo.front());
+        chosen->fifo.pop_front();
+    }
+
+    long long waitUs = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - ready.enqueued).count();
+    int bucket = std::min(WaitBuckets - 1, (int)std::bit_width((unsigned long long)waitUs));
+    chosen->dispatched++;
+    chosen->totalWaitUs += waitUs;
+    chosen->maxWaitUs = std::max(chosen->maxWaitUs, waitUs);
+    chosen->waitHistogram[bucket]++;
+    return true;
+}
+
+void ThreadedRunner::work() {
+    std::unique_lock<std::mutex> lock(dispatchMutex);
+    while (true) {
+        Ready ready;
+        workReady.wait(lock, [this, &ready]() { return pick(ready) || stopping; });
+        if (!ready.callback) {
+            return;
+        }
+        ++busy;
+        lock.unlock();
+        ready.callback();
+        ready.callback = nullptr;
+        lock.lock();
+        --busy;
+        if (busy == 0) {
+            allDone.notify_all();
+        }
+    }
+}
+
 void ThreadedRunner::join() {
-    while (threads.size() > 0) {
-        std::vector<std::thread> threadsT = std::move(threads);
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(dispatchMutex);
+            allDone.wait(lock, [this]() {
+                if (busy > 0) {
+                    return false;
+                }
+                for (const LaneQueue &queue : lanes) {
+                    if (queue.size() > 0) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
+
+        std::vector<std::thread> threadsT;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            threadsT = std::move(threads);
+            threads.clear();
+        }
+        if (threadsT.empty()) {
+            break;
+        }
         for (std::thread &thread : threadsT) {
             threadLog("Joining thread", thread.get_id());
             thread.join();
         }
     }
-}
\ No newline at end of file
+}
+
+LaneStats ThreadedRunner::stats(Lane lane) const {
+    std::lock_guard<std::mutex> lock(dispatchMutex);
+    const LaneQueue &queue = lanes[(int)lane];
+
+    long long p99WaitUs = 0;
+    long seen = 0;
+    for (int bucket = 0; bucket < WaitBuckets; ++bucket) {
+        seen += queue.waitHistogram[bucket];
+        if (queue.dispatched > 0 && seen * 100 >= queue.dispatched * 99) {
+            p99WaitUs = bucket == 0 ? 0 : (1LL << bucket) - 1;
+            break;
+        }
+    }
+    return { queue.size(), queue.maxQueueLength, queue.dispatched, queue.totalWaitUs, queue.maxWaitUs, p99WaitUs };
+}
@@ -1,13 +1,99 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <vector>
 #include <thread>
+#include <mutex>
 #include <functional>
 
+enum class Lane { Interactive, Normal, Background };
+
+struct LaneStats {
+    int queueLength;
+    int maxQueueLength;
+    long dispatched;
+    long long totalWaitUs;
+    long long maxWaitUs;
+    // Upper bound of the histogram bucket holding the 99th percentile.
+    long long p99WaitUs;
+};
+
+// Each delay sleeps on its own timer thread; once it expires the callback
+// joins a dispatch queue served by a fixed set of workers. The queue has one
+// lane per priority class, picked by smooth weighted round robin, and
+// callbacks given a deadline run earliest-deadline-first within their lane,
+// ahead of that lane's FIFO work.
+//
+// Unlike the old thread-per-callback runner, only workerCount callbacks run
+// at a time. A callback that blocks until another callback of the same
+// runner has run (e.g. SyncWait on a DelayedFor Task) holds a worker while
+// it waits, and once every worker does so the runner deadlocks. Block on
+// such work from outside the runner, or give it more workers than it can
+// have blocked callbacks.
 class ThreadedRunner {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int LaneCount = 3;
+    static constexpr int WaitBuckets = 40;
+
 private:
+    struct Ready {
+        Clock::time_point enqueued;
+        Clock::time_point deadline;
+        long sequence;
+        std::function<void()> callback;
+
+        bool operator > (const Ready &ready) const {
+            return deadline != ready.deadline ? deadline > ready.deadline : sequence > ready.sequence;
+        }
+    };
+
+    struct LaneQueue {
+        int weight;
+        int current = 0;
+        std::deque<Ready> fifo;
+        std::vector<Ready> deadlines;   // min-heap on deadline
+
+        int maxQueueLength = 0;
+        long dispatched = 0;
+        long long totalWaitUs = 0;
+        long long maxWaitUs = 0;
+        std::array<long, WaitBuckets> waitHistogram{};
+
+        int size() const { return (int)(fifo.size() + deadlines.size()); }
+    };
+
+    std::mutex mutex;
     std::vector<std::thread> threads;
+
+    mutable std::mutex dispatchMutex;
+    std::condition_variable workReady;
+    std::condition_variable allDone;
+    std::array<LaneQueue, LaneCount> lanes;
+    std::vector<std::thread> workers;
+    long sequence = 0;
+    int busy = 0;
+    bool stopping = false;
+
+    void enqueue(Lane lane, Clock::time_point deadline, std::function<void()> &&callback);
+    void schedule(int ms, Lane lane, Clock::time_point deadline, std::function<void()> &&callback);
+    bool pick(Ready &ready);
+    void work();
 public:
+    // Weights are per lane in Lane order.
+    explicit ThreadedRunner(int workerCount = std::thread::hardware_concurrency(), std::array<int, LaneCount> weights = { 8, 4, 1 });
+    ~ThreadedRunner();
+
+    ThreadedRunner(const ThreadedRunner &) = delete;
+    ThreadedRunner &operator = (const ThreadedRunner &) = delete;
+
     void delay(int ms, std::function<void()> &&callback);
+    void delay(int ms, std::function<void()> &&callback, Lane lane);
+    void delay(int ms, std::function<void()> &&callback, Lane lane, Clock::time_point deadline);
     void join();
+
+    LaneStats stats(Lane lane) const;
 };
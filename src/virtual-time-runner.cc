@@ -0,0 +1,39 @@
+#include "./virtual-time-runner.h"
+
+void VirtualTimeRunner::delay(int ms, std::function<void()> &&callback) {
+    pending.push({ now + (ms > 0 ? ms : 0), sequence++, std::move(callback) });
+}
+
+long long VirtualTimeRunner::Now() const {
+    return now;
+}
+
+int VirtualTimeRunner::Pending() const {
+    return (int)pending.size();
+}
+
+void VirtualTimeRunner::runNext() {
+    // Move the callback out before popping, since it may schedule more.
+    std::function<void()> callback = std::move(const_cast<Entry &>(pending.top()).callback);
+    now = pending.top().due;
+    pending.pop();
+    callback();
+}
+
+void VirtualTimeRunner::AdvanceBy(int ms) {
+    // The clock never goes backwards; a negative step is treated as 0.
+    long long until = now + (ms > 0 ? ms : 0);
+    while (!pending.empty() && pending.top().due <= until) {
+        runNext();
+    }
+    now = until;
+}
+
+int VirtualTimeRunner::RunUntilIdle() {
+    int count = 0;
+    while (!pending.empty()) {
+        runNext();
+        ++count;
+    }
+    return count;
+}
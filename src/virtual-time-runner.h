@@ -0,0 +1,41 @@
+#pragma once
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+// Single-threaded stand-in for ThreadedRunner. delay() only records the
+// callback on a simulated clock; nothing runs until time is advanced, and
+// callbacks due at the same time run in the order they were scheduled.
+class VirtualTimeRunner {
+private:
+    struct Entry {
+        long long due;
+        long long sequence;
+        std::function<void()> callback;
+
+        bool operator > (const Entry &entry) const {
+            return due != entry.due ? due > entry.due : sequence > entry.sequence;
+        }
+    };
+
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pending;
+    long long now = 0;
+    long long sequence = 0;
+
+    void runNext();
+public:
+    void delay(int ms, std::function<void()> &&callback);
+
+    // Milliseconds since the runner was created.
+    long long Now() const;
+    int Pending() const;
+
+    // Run everything due within the next ms, including callbacks scheduled
+    // along the way, and leave the clock at Now() + ms. Negative ms counts
+    // as 0, so time only moves forward.
+    void AdvanceBy(int ms);
+    // Jump from deadline to deadline until nothing is pending. Returns the
+    // number of callbacks run.
+    int RunUntilIdle();
+};
@@ -0,0 +1,69 @@
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "./virtual-time.h"
+#include "./task.h"
+#include "./virtual-time-runner.h"
+#include "./thread-log.h"
+
+template <typename T>
+using Tk = Task<std::function, T>;
+
+template <typename T>
+using Hdl = typename Tk<T>::Handler;
+
+// Retries with exponential backoff, as in Tasks2Demo: fails `failures`
+// times, then resolves with 6. Returns the virtual time of completion.
+static long long backoff(int failures) {
+    VirtualTimeRunner clock;
+    auto runner = [&clock](int ms, std::function<void()> &&callback) {
+        clock.delay(ms, std::move(callback));
+    };
+
+    int attempts = 0;
+    auto attempt = Tk<std::optional<int>>([&attempts, failures](const Hdl<std::optional<int>> &handler) {
+        handler(attempts++ < failures ? std::nullopt : std::optional<int>(6));
+    });
+
+    auto task = attempt;
+    for (int i = 0, ms = 1000; i < failures; ++i, ms *= 2) {
+        task = task.Or(attempt.DelayedFor(runner, ms));
+    }
+
+    long long resolvedAt = -1;
+    task.Run([&clock, &resolvedAt](std::optional<int> &&value) {
+        resolvedAt = value ? clock.Now() : -1;
+    });
+    clock.RunUntilIdle();
+    return resolvedAt;
+}
+
+void VirtualTimeDemo::run() {
+    auto start = std::chrono::steady_clock::now();
+
+    // Same result on every run, without sleeping
+    for (int failures = 0; failures <= 4; ++failures) {
+        threadLog("Failures", failures, "resolved at virtual ms", backoff(failures));
+    }
+
+    // Stepping the clock by hand
+    VirtualTimeRunner clock;
+    auto runner = [&clock](int ms, std::function<void()> &&callback) {
+        clock.delay(ms, std::move(callback));
+    };
+    std::vector<int> order;
+    Tk<int>::Resolve(1).ThenDelayFor(runner, 300).Run([&order](int &&x) { order.push_back(x); });
+    Tk<int>::Resolve(2).DelayedFor(runner, 100).Run([&order](int &&x) { order.push_back(x); });
+    Tk<int>::Resolve(3).DelayedFor(runner, 100).Run([&order](int &&x) { order.push_back(x); });
+
+    clock.AdvanceBy(99);
+    threadLog("At", clock.Now(), "completed", order.size(), "pending", clock.Pending());
+    clock.AdvanceBy(1);
+    threadLog("At", clock.Now(), "completed", order.size(), "first", order[0], "second", order[1]);
+    clock.AdvanceBy(1000);
+    threadLog("At", clock.Now(), "completed", order.size(), "third", order[2]);
+
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    threadLog("Wall time us", elapsed.count());
+}
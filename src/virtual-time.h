@@ -0,0 +1,7 @@
+#pragma once
+
+class VirtualTimeDemo {
+public:
+    static constexpr const char* name = "VirtualTime";
+    static void run();
+};